@@ -0,0 +1,54 @@
+#!/bin/bash
+#
+# bench.sh
+#
+# Compares the cost of command substitution in fcsh and bash on the same inputs.
+# Compara el coste de la sustitución de comandos en fcsh y bash con las mismas entradas.
+#
+# Both sides use a builtin (`exit` in fcsh, `:` in bash), so the time measured is
+# capturing and splitting the output. With an external command, a substitution of
+# tens of MB exceeds the kernel argument limit (E2BIG) and execvp fails, in fcsh
+# with just "Fallo al intentar ejecutar <comando>".
+#
+# Startup is not part of the comparison: each shell is first timed on an empty
+# command (`exit` / `:`) and that baseline is subtracted from every measurement.
+# For fcsh the baseline includes the `system("clear")` run by Ejecutar(); TERM is
+# set to dumb so that clear writes nothing to the benchmark output.
+#
+# Usage/Uso: ./bench.sh [lines...]   (default: 100000 1000000 5000000)
+
+set -e
+cd "$(dirname "$0")"
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+g++ -O2 main.cpp fcsh.cpp -o "$TMP/fcsh"
+
+RUNS=5
+
+# Average wall time in microseconds of $RUNS executions of the given command
+Medir() {
+	local Inicio Fin
+	Inicio=${EPOCHREALTIME/[.,]/}
+	for ((i = 0; i < RUNS; i++)); do
+		"$@" > /dev/null
+	done
+	Fin=${EPOCHREALTIME/[.,]/}
+	echo $(((Fin - Inicio) / RUNS))
+}
+
+Fcsh() { echo "$1" | TERM=dumb "$TMP/fcsh"; }
+Bash() { bash -c "$1"; }
+
+BaseFcsh=$(Medir Fcsh "exit")
+BaseBash=$(Medir Bash ":")
+echo "startup baseline (ms): fcsh $((BaseFcsh / 1000)), bash $((BaseBash / 1000))"
+
+for n in ${@:-100000 1000000 5000000}; do
+	seq 1 "$n" > "$TMP/input.txt"
+	TFcsh=$(Medir Fcsh "exit \$(cat $TMP/input.txt)")
+	TBash=$(Medir Bash ": \$(cat $TMP/input.txt)")
+	echo "== seq 1 $n ($(wc -c < "$TMP/input.txt") bytes), ms without startup:" \
+	     "fcsh $(((TFcsh - BaseFcsh) / 1000)), bash $(((TBash - BaseBash) / 1000))"
+done
@@ -8,6 +8,8 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -28,6 +30,63 @@ char** StlACpp(vector<string>& Parametros)
 	return argv;	
 }
 
+/** @brief Funcin auxiliar que localiza el cierre de la sustitucin de comandos que comienza en Inicio */
+string::size_type CierreSustitucion(const string& Linea, string::size_type Inicio)
+{
+	if(Linea[Inicio] == '`') // Las comillas invertidas no admiten anidamiento
+		return Linea.find('`', Inicio + 1);
+
+	int Nivel = 0; // En $(...) hay que emparejar los parntesis anidados
+	for(string::size_type i = Inicio + 1; i < Linea.size(); i++)
+		if(Linea[i] == '(') ++Nivel;
+		else if(Linea[i] == ')' && !--Nivel) return i;
+
+	return string::npos;
+}
+
+/** @brief Funcin auxiliar que indica si en Palabra, a partir de Desde, comienza alguna sustitucin de comandos */
+bool ContieneSustitucion(const string& Palabra, string::size_type Desde)
+{
+	return Palabra.find("$(", Desde) != string::npos || Palabra.find('`', Desde) != string::npos;
+}
+
+/** @brief Funcin auxiliar que lee todo el contenido de fd en un bfer creciente obtenido con malloc.
+ *  Si no lo consigue devuelve NULL, dejando en errno la causa (ENOMEM si falta memoria) */
+char* LeerTodo(int fd, size_t& Longitud)
+{
+	const size_t Bloque = 64 * 1024; // Mnimo espacio libre que se ofrece a cada read
+	size_t Capacidad = Bloque;
+	char* Bufer = (char*) malloc(Capacidad);
+
+	Longitud = 0;
+	while(Bufer) {
+		if(Capacidad - Longitud < Bloque) { // Si queda poco espacio se duplica la capacidad
+			char* Nuevo = (char*) realloc(Bufer, Capacidad *= 2);
+			if(!Nuevo) {
+				free(Bufer);
+				errno = ENOMEM;
+				return NULL;
+			}
+			Bufer = Nuevo;
+		}
+		// Se lee directamente sobre el espacio libre del bfer, sin copias intermedias
+		ssize_t n = read(fd, Bufer + Longitud, Capacidad - Longitud);
+		if(n > 0) Longitud += n;
+		else if(n == 0) break;
+		else if(errno != EINTR) { // Un fallo de lectura no puede pasar por una salida completa
+			int Causa = errno;
+			free(Bufer);
+			errno = Causa;
+			return NULL;
+		}
+	}
+
+	return Bufer;
+}
+
+/** @brief Funcin auxiliar que indica si un carcter separa palabras, con el mismo criterio que el operador >> */
+inline bool EsSeparador(char c) { return isspace((unsigned char) c); }
+
 /* 
  * Ejecutar
  * 
@@ -37,7 +96,7 @@ char** StlACpp(vector<string>& Parametros)
  */
 int FcSh::Ejecutar()
 {
-	bool Salir = false;
+	bool Salir = false, Error;
 	
 	// Muestro unas breves indicaciones sobre el funcionamiento del intrprete
 	system("clear");
@@ -47,6 +106,8 @@ int FcSh::Ejecutar()
 	     << "Puedes utilizar los metacaracteres < y > para redireccionar entrada y salida," << endl
 	     << "combinndolos si interesa, as como el metacarcter | para crear una" << endl 
 	     << "interconexin entre dos procesos. No se pueden combinar < y/o > con |." << endl << endl
+	     << "Con $( comando ) o ` comando ` la salida del comando se sustituye, palabra a" << endl
+	     << "palabra, como argumentos de la lnea de comandos." << endl << endl
 	     << "Para salir de fcsh utiliza el comando 'exit' o pulsa Ctrl-C" << endl << endl;
 	
 	do {
@@ -56,7 +117,7 @@ int FcSh::Ejecutar()
 		MostrarPrompt(); // Se muestra el indicador de entrada
 		Comando = LeerComando(); // Se recupera una lnea de comando
 		// Se analiza su contenido
-		if(AnalizaLineaComandos(Comando, Parametros, ArchivoIn, ArchivoOut, Pipe))
+		if(AnalizaLineaComandos(Comando, Error, Parametros, ArchivoIn, ArchivoOut, Pipe))
 		    // y se procesa el comando 
 			Salir = ProcesaComando(Comando, Parametros, ArchivoIn, ArchivoOut, Pipe);
 	} while(!Salir);
@@ -95,31 +156,72 @@ string FcSh::LeerComando()
  * 
  * Este mtodo toma como entrada la lnea de comandos completa y un vector de cadenas en
  * el que se devolver la lista de parmetros. El valor de retorno, de tipo bool, indica
- * si se ha introducido algo o la lnea de comandos estaba vaca.
+ * si se ha introducido algo o la lnea de comandos estaba vaca. En Error se indica si
+ * la lnea se ha descartado por estar mal formada, en lugar de por estar vaca.
  * 
  */
-bool FcSh::AnalizaLineaComandos(string& Comando, vector<string>& Parametros, string& ArchivoIn, string& ArchivoOut, vector<string>& Pipe)
+bool FcSh::AnalizaLineaComandos(string& Comando, bool& Error, vector<string>& Parametros, string& ArchivoIn, string& ArchivoOut, vector<string>& Pipe)
 {
 	stringstream Entrada(Comando); // Tratamos la cadena de entrada como un flujo o stream
 	string Elemento;
 	vector<string>* Destino = &Parametros;
 		
+	Error = true; // Mientras no se llegue al final del anlisis
 	while(Entrada >> Elemento) // Vamos obteniendo las palabras de la cadena
 		// Comprobamos la aparicin de <, > y |
 		switch(Elemento[0]) {
 			case '<': // Tras el carcter < estar el nombre de archivo
 			    Entrada >> ArchivoIn;
+			    if(ContieneSustitucion(ArchivoIn, 0)) {
+			    	cerr << "No se admite la sustitucin de comandos en un redireccionamiento" << endl;
+			    	return false;
+			    }
 				break;			    
 			case '>':
 			    Entrada >> ArchivoOut;
+			    if(ContieneSustitucion(ArchivoOut, 0)) {
+			    	cerr << "No se admite la sustitucin de comandos en un redireccionamiento" << endl;
+			    	return false;
+			    }
 			    break;
 			case '|':
 			    Destino = &Pipe;
 			    break; 
+			case '$': // Sustitucin de comandos con $(...)
+			case '`': // o con `...`
+			    if(Elemento[0] == '`' || (Elemento.size() > 1 && Elemento[1] == '(')) {
+			    	// Localizo en la lnea el inicio y el cierre de la sustitucin, que puede contener espacios
+			    	string::size_type Inicio = (Entrada.eof() ? Comando.size() : (string::size_type)Entrada.tellg()) - Elemento.size();
+			    	string::size_type Cierre = CierreSustitucion(Comando, Inicio);
+			    	if(Cierre == string::npos) {
+			    		cerr << "Falta el cierre de la sustitucin de comandos" << endl;
+			    		return false;
+			    	}
+			    	if(Cierre + 1 < Comando.size() && !EsSeparador(Comando[Cierre + 1])) {
+			    		cerr << "La sustitucin de comandos ha de ser una palabra independiente" << endl;
+			    		return false;
+			    	}
+			    	string::size_type Salto = Elemento[0] == '`' ? 1 : 2;
+			    	if(!SustituyeComando(Comando.substr(Inicio + Salto, Cierre - Inicio - Salto), *Destino))
+			    		return false;
+			    	// y contino analizando tras el cierre
+			    	Entrada.clear();
+			    	Entrada.seekg(Cierre + 1);
+			    } else if(ContieneSustitucion(Elemento, 1)) {
+			    	cerr << "La sustitucin de comandos ha de ser una palabra independiente" << endl;
+			    	return false;
+			    } else
+			    	Destino->push_back(Elemento); // Un $ aislado es una palabra ms
+			    break;
 			default:  // por defecto 
+			    if(ContieneSustitucion(Elemento, 1)) { // no se admiten sustituciones dentro de una palabra
+			    	cerr << "La sustitucin de comandos ha de ser una palabra independiente" << endl;
+			    	return false;
+			    }
 	    		Destino->push_back(Elemento); // las almacenamos como elementos individuales del vector
 		}
 	
+	Error = false;
 	if(Parametros.size())
 		Comando = Parametros[0]; // El primer elemento es el ejecutable
 
@@ -152,7 +254,7 @@ bool FcSh::ProcesaComando(string Comando, vector<string>& Parametros, string Arc
 	        // sustituyo el proceso actual por el del comando indicado
 	 	    if(execvp(Comando.c_str(), argv) == -1) {
 	 	    	// teniendo en cuenta un posible fallo
-	 	    	cout << "Fallo al intentar ejecutar " << Comando << endl;
+	 	    	cerr << "Fallo al intentar ejecutar " << Comando << endl;
 	 	    	exit(-1);
 	 	    }
 		}
@@ -165,7 +267,7 @@ bool FcSh::ProcesaComando(string Comando, vector<string>& Parametros, string Arc
 	        // sustituyo el proceso actual por el del comando indicado
 	 	    if(execvp(Pipe[0].c_str(), argv) == -1) {
 	 	    	// teniendo en cuenta un posible fallo
-	 	    	cout << "Fallo al intentar ejecutar " << Pipe[0] << endl;
+	 	    	cerr << "Fallo al intentar ejecutar " << Pipe[0] << endl;
 	 	    	exit(-1);
 	 	    }
 		}
@@ -191,7 +293,7 @@ bool FcSh::ProcesaComando(string Comando, vector<string>& Parametros, string Arc
 		if(!ArchivoIn.empty()) {
 			int fIn = open(ArchivoIn.c_str(), O_RDONLY);
 			if(fIn == -1) {
-				cout << "Fallo al abrir el archivo " << ArchivoIn << endl;
+				cerr << "Fallo al abrir el archivo " << ArchivoIn << endl;
 				exit(-1);
 			}
 			dup2(fIn, STDIN_FILENO);
@@ -201,7 +303,7 @@ bool FcSh::ProcesaComando(string Comando, vector<string>& Parametros, string Arc
 		if(!ArchivoOut.empty()) {
 			int fOut = open(ArchivoOut.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
 			if(fOut == -1) {
-				cout << "Fallo al crear el archivo " << ArchivoOut << endl;
+				cerr << "Fallo al crear el archivo " << ArchivoOut << endl;
 				exit(-1);
 			}
 			dup2(fOut, STDOUT_FILENO);
@@ -210,7 +312,7 @@ bool FcSh::ProcesaComando(string Comando, vector<string>& Parametros, string Arc
         // sustituyo el proceso actual por el del comando indicado
  	    if(execvp(Comando.c_str(), argv) == -1) {
  	    	// teniendo en cuenta un posible fallo
- 	    	cout << "Fallo al intentar ejecutar " << Comando << endl;
+ 	    	cerr << "Fallo al intentar ejecutar " << Comando << endl;
  	    	exit(-1);
  	    }
 	} else { // Si ste es el proceso padre
@@ -220,3 +322,76 @@ bool FcSh::ProcesaComando(string Comando, vector<string>& Parametros, string Arc
 	return false; // No se quiere salir del intrprete
 }
 
+
+/*
+ * SustituyeComando
+ * 
+ * Este mtodo ejecuta la lnea de comandos recibida, que puede contener a su vez interconexiones,
+ * redireccionamientos y otras sustituciones, capturando su salida y aadiendo al vector indicado
+ * cada una de las palabras que la componen. Devuelve false si no ha sido posible ejecutarla.
+ * 
+ */
+bool FcSh::SustituyeComando(const string& Linea, vector<string>& Destino)
+{
+	string Comando(Linea), ArchivoIn, ArchivoOut;
+	vector<string> Parametros, Pipe;
+	bool Error;
+
+	if(!AnalizaLineaComandos(Comando, Error, Parametros, ArchivoIn, ArchivoOut, Pipe))
+		return !Error; // Una sustitucin vaca no aporta ninguna palabra, pero un error anula la lnea
+
+	int fds[2];
+	if(pipe(fds) == -1) {
+		cerr << "Fallo al crear la tubera para " << Comando << endl;
+		return false;
+	}
+#ifdef F_SETPIPE_SZ
+	fcntl(fds[0], F_SETPIPE_SZ, 1024 * 1024); // Una tubera mayor reduce los cambios de contexto con salidas grandes
+#endif
+
+	cout.flush(); // Evito que el hijo herede y repita lo pendiente de escribir
+	int f = fork();
+	if(f == -1) {
+		close(fds[0]);
+		close(fds[1]);
+		cerr << "Fallo al crear el proceso para " << Comando << endl;
+		return false;
+	}
+	if(!f) { // El hijo ejecuta el comando con la salida estndar desviada a la tubera
+		close(fds[0]);
+		dup2(fds[1], STDOUT_FILENO);
+		close(fds[1]);
+
+		ProcesaComando(Comando, Parametros, ArchivoIn, ArchivoOut, Pipe);
+		exit(0);
+	}
+
+	// El padre recoge toda la salida antes de esperar, para que el hijo no se bloquee con la tubera llena
+	close(fds[1]);
+	size_t Longitud;
+	char* Bufer = LeerTodo(fds[0], Longitud);
+	int Causa = errno;
+	close(fds[0]);
+	waitpid(f, NULL, 0); // Como en sh, el estado del comando no afecta a la sustitucin
+
+	if(!Bufer) {
+		if(Causa == ENOMEM)
+			cerr << "Memoria insuficiente para la salida de " << Comando << endl;
+		else
+			cerr << "Fallo al leer la salida de " << Comando << ": " << strerror(Causa) << endl;
+		return false;
+	}
+
+	// Separo las palabras recorriendo el bfer y construyendo cada cadena de una sola vez
+	const char* p = Bufer, *Final = Bufer + Longitud;
+	while(p < Final) {
+		while(p < Final && EsSeparador(*p)) ++p;
+		const char* Palabra = p;
+		while(p < Final && !EsSeparador(*p)) ++p;
+		if(p > Palabra)
+			Destino.push_back(string(Palabra, p - Palabra));
+	}
+
+	free(Bufer);
+	return true;
+}
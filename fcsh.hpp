@@ -24,8 +24,9 @@ public:
 private:
 	void MostrarPrompt();
 	string LeerComando();
-	bool AnalizaLineaComandos(string&, vector<string>&, string&, string&, vector<string>&);
+	bool AnalizaLineaComandos(string&, bool&, vector<string>&, string&, string&, vector<string>&);
 	bool ProcesaComando(string, vector<string>&, string, string, vector<string>&);
+	bool SustituyeComando(const string&, vector<string>&);
 };
 
 #endif /*FCSH_H_*/